@@ -1,8 +1,18 @@
 """Main app entrypoint. Starts Uvicorn-based REST API service."""
 
+import atexit
+import hashlib
+import json
 import logging
+import logging.handlers
 import os
+import queue
+import random
+import re
+import shutil
+import signal
 import tempfile
+import threading
 from pathlib import Path
 
 import uvicorn
@@ -10,19 +20,77 @@ import uvicorn
 from ols.utils import config
 from ols.utils.logging import configure_logging
 
+# probes and metrics scrapes must pass even when the service is saturated
+UNLIMITED_PATHS = ("/liveness", "/readiness", "/metrics")
 
-def configure_hugging_face_envs(ols_config) -> None:
-    """Configure HuggingFace library environment variables."""
+
+def embeddings_model_path(ols_config) -> str | None:
+    """Return path to embedding model configured in reference content, if any."""
     if (
         ols_config
         and hasattr(ols_config, "reference_content")
         and hasattr(ols_config.reference_content, "embeddings_model_path")
         and ols_config.reference_content.embeddings_model_path
     ):
-        os.environ["TRANSFORMERS_CACHE"] = (
-            ols_config.reference_content.embeddings_model_path
-        )
+        return ols_config.reference_content.embeddings_model_path
+    return None
+
+
+def configure_hugging_face_envs(ols_config) -> None:
+    """Configure HuggingFace library environment variables."""
+    model_path = embeddings_model_path(ols_config)
+    if model_path:
+        os.environ["TRANSFORMERS_CACHE"] = model_path
         os.environ["TRANSFORMERS_OFFLINE"] = "1"
+        os.environ["HF_HUB_OFFLINE"] = "1"
+
+
+def parse_manifest_line(line: str, line_number: int) -> tuple[str, str]:
+    """Parse one line of manifest in `sha256sum` format into digest and filename."""
+    # filenames with backslash or newline are escaped, marked by leading backslash
+    escaped = line.startswith("\\")
+    if escaped:
+        line = line[1:]
+    match = re.fullmatch(r"([0-9a-fA-F]{64}) [ *](.+)", line)
+    if not match:
+        raise ValueError(f"Malformed manifest line {line_number}: {line!r}")
+    expected, filename = match.groups()
+    if escaped:
+        escapes = {"\\": "\\", "n": "\n", "r": "\r"}
+        parts = re.split(r"\\(.)", filename)
+        for i in range(1, len(parts), 2):
+            if parts[i] not in escapes or "\\" in parts[i - 1]:
+                raise ValueError(f"Malformed manifest line {line_number}: {line!r}")
+            parts[i] = escapes[parts[i]]
+        if "\\" in parts[-1]:
+            raise ValueError(f"Malformed manifest line {line_number}: {line!r}")
+        filename = "".join(parts)
+    return expected.lower(), filename
+
+
+def verify_model_manifest(model_path: str) -> None:
+    """Verify model files against `manifest.sha256` in model directory, if present."""
+    model_dir = Path(model_path).resolve()
+    manifest = model_dir / "manifest.sha256"
+    if not manifest.is_file():
+        return
+    lines = manifest.read_text(encoding="utf-8").splitlines()
+    for line_number, line in enumerate(lines, 1):
+        if not line.strip():
+            continue
+        expected, filename = parse_manifest_line(line, line_number)
+        model_file = (model_dir / filename).resolve()
+        if not model_file.is_relative_to(model_dir):
+            raise ValueError(
+                f"Manifest line {line_number} points outside model directory: "
+                f"{filename!r}"
+            )
+        digest = hashlib.sha256()
+        with open(model_file, "rb") as f:
+            for chunk in iter(lambda: f.read(1024 * 1024), b""):
+                digest.update(chunk)
+        if digest.hexdigest() != expected:
+            raise ValueError(f"Checksum mismatch for model file {filename}")
 
 
 def configure_gradio_ui_envs() -> None:
@@ -38,6 +106,323 @@ def configure_gradio_ui_envs() -> None:
     os.environ["MPLCONFIGDIR"] = tempdir
 
 
+class LoggerQueueHandler(logging.handlers.QueueHandler):
+    """Queue handler putting records to the queue along with their target handlers."""
+
+    def __init__(self, log_queue: queue.SimpleQueue, handlers: list) -> None:
+        """Initialize the handler standing in for given handlers of one logger."""
+        super().__init__(log_queue)
+        self.target_handlers = handlers
+        # don't prepare records that none of the handlers would emit
+        self.setLevel(min(handler.level for handler in handlers))
+
+    def enqueue(self, record: logging.LogRecord) -> None:
+        """Put the record to the queue together with its target handlers."""
+        self.queue.put_nowait((self.target_handlers, record))
+
+
+class FanOutQueueListener(logging.handlers.QueueListener):
+    """Queue listener passing records to the handlers they were queued for."""
+
+    def handle(self, item) -> None:
+        """Pass the record to its target handlers respecting their levels."""
+        handlers, record = item
+        for handler in handlers:
+            if record.levelno >= handler.level:
+                handler.handle(record)
+
+
+class JsonFormatter(logging.Formatter):
+    """Formatter writing log records as JSON objects, one per line."""
+
+    def format(self, record: logging.LogRecord) -> str:
+        """Format the record as JSON object."""
+        # tracebacks are already merged into the message by QueueHandler.prepare
+        return json.dumps(
+            {
+                "time": self.formatTime(record),
+                "level": record.levelname,
+                "logger": record.name,
+                "message": record.getMessage(),
+            }
+        )
+
+
+class SamplingFilter(logging.Filter):
+    """Filter passing given share of records below WARNING, per logger name."""
+
+    def __init__(self, rates: dict[str, float]) -> None:
+        """Initialize the filter with sampling rates keyed by logger name."""
+        super().__init__()
+        # the most specific logger name wins
+        self.rates = sorted(rates.items(), key=lambda item: -len(item[0]))
+
+    def filter(self, record: logging.LogRecord) -> bool:
+        """Decide whether the record is written."""
+        if record.levelno >= logging.WARNING:
+            return True
+        # decide once, the record reaches handlers of all its parent loggers
+        if not hasattr(record, "sampled"):
+            record.sampled = True
+            for name, rate in self.rates:
+                if record.name == name or record.name.startswith(name + "."):
+                    record.sampled = random.random() < rate  # noqa: S311
+                    break
+        return record.sampled
+
+
+def log_sample_rates() -> dict[str, float]:
+    """Return sampling rates per logger name set by OLS_LOG_SAMPLE_RATES."""
+    rates = {}
+    for item in os.environ.get("OLS_LOG_SAMPLE_RATES", "").split(","):
+        if not item.strip():
+            continue
+        name, _, rate = item.partition("=")
+        error = (
+            "OLS_LOG_SAMPLE_RATES items must be logger=rate with rate "
+            f"between 0 and 1, got {item!r}"
+        )
+        try:
+            value = float(rate)
+        except ValueError:
+            raise ValueError(error) from None
+        if not 0 <= value <= 1:
+            raise ValueError(error)
+        rates[name.strip()] = value
+    return rates
+
+
+# listener started by configure_queue_logging
+log_listener: FanOutQueueListener | None = None
+
+
+def configure_queue_logging() -> None:
+    """Move log handlers behind a queue served by a background thread.
+
+    Only handlers existing at the time of the call are moved, Uvicorn loggers
+    excepted; handlers added later, e.g. on importing the app, are not.
+    """
+    global log_listener
+    loggers = [logging.getLogger()] + [
+        logger
+        for name, logger in logging.Logger.manager.loggerDict.items()
+        if isinstance(logger, logging.Logger) and not name.startswith("uvicorn")
+    ]
+    rates = log_sample_rates()
+    json_output = os.environ.get("OLS_LOG_JSON", "").lower() in ("1", "true")
+    log_queue: queue.SimpleQueue = queue.SimpleQueue()
+    for logger in loggers:
+        if not logger.handlers:
+            continue
+        if json_output:
+            for handler in logger.handlers:
+                handler.setFormatter(JsonFormatter())
+        queue_handler = LoggerQueueHandler(log_queue, logger.handlers)
+        if rates:
+            # sample before the record is prepared in the emitting thread
+            queue_handler.addFilter(SamplingFilter(rates))
+        logger.handlers = [queue_handler]
+    log_listener = FanOutQueueListener(log_queue)
+    log_listener.start()
+    # Uvicorn servers die on re-raised SIGTERM without running atexit, they
+    # stop the listener on lifespan shutdown instead, see WarmupGate
+    atexit.register(stop_queue_logging)
+
+
+def flush_queue_logging() -> None:
+    """Wait until all queued log records are written."""
+    if log_listener:
+        log_listener.stop()
+        log_listener.start()
+
+
+def stop_queue_logging() -> None:
+    """Write queued log records and stop the listener thread."""
+    global log_listener
+    if log_listener:
+        log_listener.stop()
+        log_listener = None
+
+
+async def send_unavailable(send, detail: bytes) -> None:
+    """Send 503 Service Unavailable response with given detail."""
+    await send(
+        {
+            "type": "http.response.start",
+            "status": 503,
+            "headers": [
+                (b"content-type", b"application/json"),
+                (b"retry-after", b"5"),
+            ],
+        }
+    )
+    await send(
+        {
+            "type": "http.response.body",
+            "body": b'{"detail": "' + detail + b'"}',
+        }
+    )
+
+
+class WarmupGate:
+    """ASGI application wrapper reporting the service as not ready during warm-up.
+
+    Indexes are loaded in a background thread. Until then every request but
+    liveness probe gets 503, and readiness probe also waits for all workers.
+    """
+
+    def __init__(self, app, workers: int = 1) -> None:
+        """Wrap the application served by one of the given number of workers."""
+        self.app = app
+        self.workers = workers
+        self.ready = threading.Event()
+        self.warm_up_started = False
+
+    def start_warm_up(self) -> None:
+        """Start the warm-up thread unless it is already running."""
+        if not self.warm_up_started:
+            self.warm_up_started = True
+            threading.Thread(target=self.warm_up, name="warm-up", daemon=True).start()
+
+    def warm_up(self) -> None:
+        """Verify embedding model and load the indexes needed to serve queries."""
+        logger = logging.getLogger(__name__)
+        try:
+            model_path = embeddings_model_path(config.ols_config)
+            if model_path:
+                verify_model_manifest(model_path)
+            config.init_query_filter()
+            config.init_vector_index()
+        except Exception:
+            logger.exception("Warm-up failed, stopping the service")
+            flush_queue_logging()
+            # shut down gracefully through Uvicorn's signal handling; with
+            # several workers the supervisor would just restart this worker
+            os.kill(os.getppid() if self.workers > 1 else os.getpid(), signal.SIGTERM)
+            return
+        if self.workers > 1:
+            # readiness probe passes once every worker left its marker
+            Path(os.environ["OLS_WARMUP_DIR"], str(os.getpid())).touch()
+        self.ready.set()
+        logger.info("Warm-up finished, worker is ready")
+
+    def all_workers_ready(self) -> bool:
+        """Check whether all running workers finished the warm-up."""
+        if not self.ready.is_set():
+            return False
+        if self.workers == 1:
+            return True
+        ready_workers = 0
+        for marker in Path(os.environ["OLS_WARMUP_DIR"]).iterdir():
+            try:
+                # markers of workers restarted by Uvicorn are left behind
+                os.kill(int(marker.name), 0)
+            except ProcessLookupError:
+                continue
+            ready_workers += 1
+        return ready_workers >= self.workers
+
+    async def __call__(self, scope, receive, send) -> None:
+        """Reject requests until ready, pass them to the application otherwise."""
+        # lifespan startup comes after Uvicorn installed its signal handlers
+        self.start_warm_up()
+        if scope["type"] == "lifespan":
+
+            async def send_lifespan(message) -> None:
+                """Stop log listener once the application is shut down."""
+                await send(message)
+                if message["type"] == "lifespan.shutdown.complete":
+                    stop_queue_logging()
+
+            await self.app(scope, receive, send_lifespan)
+            return
+        if scope["type"] == "http":
+            if scope["path"] == "/liveness":
+                ready = True
+            elif scope["path"] == "/readiness":
+                ready = self.all_workers_ready()
+            else:
+                ready = self.ready.is_set()
+            if not ready:
+                await send_unavailable(send, b"Service is warming up")
+                return
+        await self.app(scope, receive, send)
+
+
+class ConcurrencyGate:
+    """ASGI application wrapper rejecting requests over per-worker limit with 503."""
+
+    def __init__(self, app, limit: int) -> None:
+        """Wrap the application with given limit of concurrent requests."""
+        self.app = app
+        self.limit = limit
+        self.in_flight = 0
+
+    async def __call__(self, scope, receive, send) -> None:
+        """Pass the request to the application unless the limit is reached."""
+        if scope["type"] != "http" or scope["path"] in UNLIMITED_PATHS:
+            await self.app(scope, receive, send)
+            return
+        if self.in_flight >= self.limit:
+            await send_unavailable(send, b"Too many concurrent requests")
+            return
+        self.in_flight += 1
+        try:
+            await self.app(scope, receive, send)
+        finally:
+            self.in_flight -= 1
+
+
+def gate_app(app, workers: int, concurrency_limit: int | None):
+    """Wrap REST API application with warm-up and admission control gates."""
+    if concurrency_limit is not None:
+        app = ConcurrencyGate(app, concurrency_limit)
+    return WarmupGate(app, workers)
+
+
+def uvicorn_workers() -> int:
+    """Return number of Uvicorn worker processes configured by OLS_WORKERS."""
+    workers = int(os.environ.get("OLS_WORKERS", "1"))
+    if workers < 1:
+        raise ValueError(f"OLS_WORKERS must be at least 1, got {workers}")
+    return workers
+
+
+def uvicorn_concurrency_limit() -> int | None:
+    """Return per-worker limit of concurrent requests set by OLS_LIMIT_CONCURRENCY."""
+    if "OLS_LIMIT_CONCURRENCY" not in os.environ:
+        return None
+    limit = int(os.environ["OLS_LIMIT_CONCURRENCY"])
+    if limit < 1:
+        raise ValueError(f"OLS_LIMIT_CONCURRENCY must be at least 1, got {limit}")
+    return limit
+
+
+def create_app():
+    """Create REST API application in Uvicorn worker process."""
+    # workers are spawned, so they load the config on their own
+    try:
+        cfg_file = os.environ.get("OLS_CONFIG_FILE", "olsconfig.yaml")
+        config.init_config(cfg_file)
+        configure_logging(config.ols_config.logging_config)
+        configure_queue_logging()
+
+        configure_hugging_face_envs(config.ols_config)
+
+        from ols.app.main import app
+
+        # both settings were already validated by the parent process
+        return gate_app(app, uvicorn_workers(), uvicorn_concurrency_limit())
+    except Exception:
+        logging.getLogger(__name__).exception(
+            "Worker initialization failed, stopping the service"
+        )
+        flush_queue_logging()
+        # Uvicorn supervisor would just restart the failed worker
+        os.kill(os.getppid(), signal.SIGTERM)
+        raise
+
+
 if __name__ == "__main__":
 
     cfg_file = os.environ.get("OLS_CONFIG_FILE", "olsconfig.yaml")
@@ -45,6 +430,7 @@ if __name__ == "__main__":
     config.init_config(cfg_file)
 
     configure_logging(config.ols_config.logging_config)
+    configure_queue_logging()
     logger = logging.getLogger(__name__)
     logger.info(f"Config loaded from {Path(cfg_file).resolve()}")
 
@@ -55,26 +441,58 @@ if __name__ == "__main__":
     from ols.utils import config
 
     configure_hugging_face_envs(config.ols_config)
-    config.init_query_filter()
-    config.init_vector_index()
+
+    workers = uvicorn_workers()
+    concurrency_limit = uvicorn_concurrency_limit()
+    if workers == 1:
+        # single worker runs in this process, so config loaded here can be
+        # accessed from other modules
+        from ols.app.main import app as ols_app
+
+        app, factory = gate_app(ols_app, workers, concurrency_limit), False
+    else:
+        # every worker process loads its own config and indexes, see create_app
+        app, factory = "runner:create_app", True
+        # ready workers leave markers here, see WarmupGate
+        os.environ["OLS_WARMUP_DIR"] = tempfile.mkdtemp(prefix="ols-warmup-")
+        atexit.register(shutil.rmtree, os.environ["OLS_WARMUP_DIR"], True)
+        logger.warning(
+            f"Every one of {workers} workers loads its own copy of the vector "
+            "index, memory used by the index is multiplied accordingly"
+        )
+    logger.info(f"Starting {workers} Uvicorn worker(s)")
+
+    if concurrency_limit is not None:
+        logger.info(f"Concurrent requests limited to {concurrency_limit} per worker")
 
     host = "localhost" if config.dev_config.run_on_localhost else None
     log_level = config.ols_config.logging_config.uvicorn_log_level
 
-    # use workers=1 so config loaded can be accessed from other modules
     if config.dev_config.disable_tls:
         # TLS is disabled, run without SSL configuration
         uvicorn.run(
-            "ols.app.main:app", host=host, port=8080, log_level=log_level, workers=1
+            app,
+            factory=factory,
+            host=host,
+            port=8080,
+            log_level=log_level,
+            workers=workers,
         )
     else:
+        tls_options = {}
+        if "OLS_TLS_CIPHERS" in os.environ:
+            # OpenSSL cipher list for TLS 1.2, e.g. "ECDHE+AESGCM"; TLS 1.3
+            # suites and session tickets are left to OpenSSL defaults
+            tls_options["ssl_ciphers"] = os.environ["OLS_TLS_CIPHERS"]
         uvicorn.run(
-            "ols.app.main:app",
+            app,
+            factory=factory,
             host=host,
             port=8443,
-            workers=1,
+            workers=workers,
             log_level=log_level,
             ssl_keyfile=config.ols_config.tls_config.tls_key_path,
             ssl_certfile=config.ols_config.tls_config.tls_certificate_path,
             ssl_keyfile_password=config.ols_config.tls_config.tls_key_password,
+            **tls_options,
         )